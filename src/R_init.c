@@ -4,8 +4,12 @@
 #include <Rinternals.h>
 #include <R_ext/Rdynload.h>
 #include "R_init.h"
+#include "simd.h"
 
 void R_init_broman(DllInfo* info) {
     R_registerRoutines(info, NULL, NULL, NULL, NULL);
     R_useDynamicSymbols(info, TRUE);
+
+    // pick SSE2/AVX2/AVX-512 kernels for this CPU
+    simd_init();
 }
@@ -2,7 +2,7 @@
 
    Karl W Broman
 
-   last modified 25 May 2016
+   last modified 19 Oct 2026
    first written 16 July 2015
 
 */
@@ -12,29 +12,28 @@
 #include <stdio.h>
 #include <limits.h>
 #include <R.h>
+#include <Rinternals.h>
 #include <Rmath.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include "compare_rows.h"
+#include "simd.h"
 
-/* compare rows by proportion of mismatches */
+/* compare rows by proportion of mismatches
+   Mat[i] points to row i (stored contiguously) */
 void compare_rows_mismatch(int **Mat, int nrow, int ncol, double **D)
 {
-    int i, j, k, n;
+    int i, j, n, ndiff;
 
     for(i=0; i< nrow-1; i++) {
+        R_CheckUserInterrupt(); /* check for ^C */
+
         for(j=i+1; j<nrow; j++) {
-            R_CheckUserInterrupt(); /* check for ^C */
-
-            D[i][j] = 0.0;
-            n = 0;
-            for(k=0; k<ncol; k++) {
-                /* INT_MIN is the missing value for integers */
-                if(Mat[k][i] > INT_MIN && Mat[k][j] > INT_MIN) {
-                    n++;
-                    if(Mat[k][i] != Mat[k][j]) (D[i][j])++;
-                }
-            }
+            simd_mismatch(Mat[i], Mat[j], ncol, &n, &ndiff);
+
             if(n==0) D[i][j] = NA_REAL;
-            else D[i][j] /= (double)n;
+            else D[i][j] = (double)ndiff / (double)n;
 
             D[j][i] = D[i][j];
         }
@@ -42,44 +41,43 @@ void compare_rows_mismatch(int **Mat, int nrow, int ncol, double **D)
 }
 
 
-/* compare rows by RMS difference */
+/* compare rows by RMS difference
+   Mat[i] points to row i (stored contiguously) */
 void compare_rows_rmsd(double **Mat, int nrow, int ncol, double **D)
 {
-    int i, j, k, n;
-    double a;
+    int i, j, n;
+    double sumsq;
 
     for(i=0; i< nrow-1; i++) {
+        R_CheckUserInterrupt(); /* check for ^C */
+
         for(j=i+1; j<nrow; j++) {
-            R_CheckUserInterrupt(); /* check for ^C */
-
-            D[i][j] = 0.0;
-            n = 0;
-            for(k=0; k<ncol; k++) {
-                if(!ISNA(Mat[k][i]) && !ISNA(Mat[k][j])) {
-                    n++;
-                    a = (Mat[k][i] - Mat[k][j]);
-                    D[i][j] += (a*a);
-                }
-            }
+            simd_rmsd(Mat[i], Mat[j], ncol, &n, &sumsq);
+
             if(n==0) D[i][j] = NA_REAL;
-            else D[i][j] = sqrt(D[i][j] / (double)n);
+            else D[i][j] = sqrt(sumsq / (double)n);
 
             D[j][i] = D[i][j];
         }
     }
 }
 
-/* R wrappers */
+/* R wrappers
+   mat comes in column-major; the rows are copied to be contiguous so
+   that the inner loops run over adjacent memory */
 void R_compare_rows_mismatch(int *mat, int *nrow, int *ncol, double *d)
 {
-    int i=0;
+    int i, k;
     int **Mat;
     double **D;
 
-    Mat = (int **)R_alloc(*ncol, sizeof(int *));
-    Mat[0] = mat;
-    for(i=1; i< *ncol; i++)
-        Mat[i] = Mat[i-1] + *nrow;
+    Mat = (int **)R_alloc(*nrow, sizeof(int *));
+    Mat[0] = (int *)R_alloc((size_t)(*nrow) * (size_t)(*ncol), sizeof(int));
+    for(i=1; i< *nrow; i++)
+        Mat[i] = Mat[i-1] + *ncol;
+    for(k=0; k< *ncol; k++)
+        for(i=0; i< *nrow; i++)
+            Mat[i][k] = mat[i + (size_t)k * (size_t)(*nrow)];
 
     D = (double **)R_alloc(*nrow, sizeof(double *));
     D[0] = d;
@@ -91,14 +89,17 @@ void R_compare_rows_mismatch(int *mat, int *nrow, int *ncol, double *d)
 
 void R_compare_rows_rmsd(double *mat, int *nrow, int *ncol, double *d)
 {
-    int i=0;
+    int i, k;
     double **Mat;
     double **D;
 
-    Mat = (double **)R_alloc(*ncol, sizeof(double *));
-    Mat[0] = mat;
-    for(i=1; i< *ncol; i++)
-        Mat[i] = Mat[i-1] + *nrow;
+    Mat = (double **)R_alloc(*nrow, sizeof(double *));
+    Mat[0] = (double *)R_alloc((size_t)(*nrow) * (size_t)(*ncol), sizeof(double));
+    for(i=1; i< *nrow; i++)
+        Mat[i] = Mat[i-1] + *ncol;
+    for(k=0; k< *ncol; k++)
+        for(i=0; i< *nrow; i++)
+            Mat[i][k] = mat[i + (size_t)k * (size_t)(*nrow)];
 
     D = (double **)R_alloc(*nrow, sizeof(double *));
     D[0] = d;
@@ -107,3 +108,86 @@ void R_compare_rows_rmsd(double *mat, int *nrow, int *ncol, double *d)
 
     compare_rows_rmsd(Mat, *nrow, *ncol, D);
 }
+
+
+/* number of query rows compared to each reference row at a time,
+   so that each reference row is reused while it's in cache */
+#define CROSS_QBLOCK 8
+
+/* compare rows of query to rows of ref
+   by proportion of mismatches (method=1) or RMS difference (method=2)
+
+   query is ncol x n_query and ref is ncol x n_ref, so each row of the
+   original matrices is contiguous; query_obs and ref_obs are the
+   number of non-missing values in each row
+
+   D is n_query x n_ref; the query rows are split across n_threads threads */
+void compare_rows_cross(const void *query, int n_query, const int *query_obs,
+                        const void *ref, int n_ref, const int *ref_obs,
+                        int ncol, int method, double *D, int n_threads)
+{
+    int n_qblock = n_query / CROSS_QBLOCK + (n_query % CROSS_QBLOCK > 0);
+    int qb;
+
+    #pragma omp parallel for num_threads(n_threads) schedule(dynamic)
+    for(qb=0; qb<n_qblock; qb++) {
+        int q, r, n, ndiff;
+        int q0 = qb*CROSS_QBLOCK, q1 = q0 + CROSS_QBLOCK;
+        double sumsq, *d;
+        if(q1 > n_query) q1 = n_query;
+
+        for(r=0; r<n_ref; r++) {
+            d = D + (size_t)r*n_query;
+
+            if(ref_obs[r] == 0) { /* no data in reference row */
+                for(q=q0; q<q1; q++) d[q] = NA_REAL;
+                continue;
+            }
+
+            for(q=q0; q<q1; q++) {
+                if(query_obs[q] == 0) {
+                    d[q] = NA_REAL;
+                    continue;
+                }
+
+                if(method==1) {
+                    simd_mismatch((const int *)query + (size_t)q*ncol,
+                                  (const int *)ref + (size_t)r*ncol,
+                                  ncol, &n, &ndiff);
+                    d[q] = (n==0 ? NA_REAL : (double)ndiff / (double)n);
+                }
+                else {
+                    simd_rmsd((const double *)query + (size_t)q*ncol,
+                              (const double *)ref + (size_t)r*ncol,
+                              ncol, &n, &sumsq);
+                    d[q] = (n==0 ? NA_REAL : sqrt(sumsq / (double)n));
+                }
+            }
+        }
+    }
+}
+
+/* R wrapper
+   tquery and tref are the transposed matrices (integer for method=1,
+   double for method=2); query_obs and ref_obs the number of
+   non-missing values in each column */
+SEXP R_compare_rows_cross(SEXP tquery, SEXP query_obs, SEXP tref, SEXP ref_obs,
+                          SEXP method, SEXP cores)
+{
+    int ncol = nrows(tquery);
+    int n_query = ncols(tquery);
+    int n_ref = ncols(tref);
+    int meth = asInteger(method);
+    SEXP result;
+
+    PROTECT(result = allocMatrix(REALSXP, n_query, n_ref));
+
+    compare_rows_cross(meth==1 ? (const void *)INTEGER(tquery) : (const void *)REAL(tquery),
+                       n_query, INTEGER(query_obs),
+                       meth==1 ? (const void *)INTEGER(tref) : (const void *)REAL(tref),
+                       n_ref, INTEGER(ref_obs),
+                       ncol, meth, REAL(result), asInteger(cores));
+
+    UNPROTECT(1);
+    return result;
+}
@@ -2,17 +2,30 @@
 
    Karl W Broman
 
-   last modified 16 July 2015
+   last modified 19 Oct 2026
    first written 16 July 2015
 
 */
 
-/* compare rows by proportion of mismatches */
+/* compare rows by proportion of mismatches
+   Mat[i] points to row i (stored contiguously) */
 void compare_rows_mismatch(int **Mat, int nrow, int ncol, double **D);
 
-/* compare rows by RMS difference */
+/* compare rows by RMS difference
+   Mat[i] points to row i (stored contiguously) */
 void compare_rows_rmsd(double **Mat, int nrow, int ncol, double **D);
 
 /* R wrappers */
 void R_compare_rows_mismatch(int *mat, int *nrow, int *ncol, double *d);
 void R_compare_rows_rmsd(double *mat, int *nrow, int *ncol, double *d);
+
+/* compare rows of query to rows of ref
+   by proportion of mismatches (method=1) or RMS difference (method=2)
+   query and ref are stored with rows contiguous; D is n_query x n_ref */
+void compare_rows_cross(const void *query, int n_query, const int *query_obs,
+                        const void *ref, int n_ref, const int *ref_obs,
+                        int ncol, int method, double *D, int n_threads);
+
+/* R wrapper */
+SEXP R_compare_rows_cross(SEXP tquery, SEXP query_obs, SEXP tref, SEXP ref_obs,
+                          SEXP method, SEXP cores);
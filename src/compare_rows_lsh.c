@@ -0,0 +1,395 @@
+/* compare_rows_lsh.c
+
+   Karl W Broman
+
+   Find pairs of rows in a matrix that are close, by proportion of
+   mismatches or RMS difference, using locality-sensitive hashing to
+   generate candidate pairs that are then checked exactly
+
+   For each of n_tables hash tables, each row gets a key from n_bits
+   hash functions:
+     - method=1 (mismatches): the values in n_bits sampled columns
+     - method=2 (RMS): floor((a.x + b)/width) for n_bits random
+       projections a ~ N(0,I), b ~ U(0,width); missing values are
+       replaced by the column mean
+   Rows that share a key in any table are candidate pairs.
+
+*/
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <R.h>
+#include <Rinternals.h>
+#include <Rmath.h>
+#include <R_ext/Utils.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "compare_rows_lsh.h"
+#include "simd.h"
+#include "rng_streams.h"
+
+typedef struct {
+    uint64_t key;
+    int row;
+} lsh_key;
+
+static int compare_key(const void *a, const void *b)
+{
+    const lsh_key *x = (const lsh_key *)a, *y = (const lsh_key *)b;
+    if(x->key != y->key) return (x->key > y->key) - (x->key < y->key);
+    return (x->row > y->row) - (x->row < y->row);
+}
+
+static int compare_uint64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* combine a value into a 64-bit hash */
+static inline uint64_t hash_combine(uint64_t h, uint64_t v)
+{
+    v *= 0xff51afd7ed558ccdULL;
+    v ^= v >> 33;
+    return h ^ (v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2));
+}
+
+/* keys by bit sampling: values in columns cols[0..n_bits-1] */
+static void lsh_keys_mismatch(const int *tmat, int nrow, int ncol,
+                              const int *cols, int n_bits,
+                              lsh_key *keys, int n_threads)
+{
+    int i;
+
+    #pragma omp parallel for num_threads(n_threads)
+    for(i=0; i<nrow; i++) {
+        const int *x = tmat + (size_t)i*ncol;
+        uint64_t h = 0;
+        int b;
+
+        for(b=0; b<n_bits; b++)
+            h = hash_combine(h, (uint64_t)(int64_t)x[cols[b]]);
+
+        keys[i].key = h;
+        keys[i].row = i;
+    }
+}
+
+/* keys by random projections; proj is n_bits x ncol (row b contiguous) */
+static void lsh_keys_rmsd(const double *tmat, int nrow, int ncol,
+                          const double *colmean, const double *proj,
+                          const double *offset, int n_bits, double width,
+                          lsh_key *keys, int n_threads)
+{
+    int i;
+
+    #pragma omp parallel for num_threads(n_threads)
+    for(i=0; i<nrow; i++) {
+        const double *x = tmat + (size_t)i*ncol;
+        uint64_t h = 0;
+        int b, k;
+        double s;
+
+        for(b=0; b<n_bits; b++) {
+            const double *a = proj + (size_t)b*ncol;
+            s = offset[b];
+            for(k=0; k<ncol; k++)
+                s += a[k] * (ISNAN(x[k]) ? colmean[k] : x[k]);
+            h = hash_combine(h, (uint64_t)(int64_t)floor(s / width));
+        }
+
+        keys[i].key = h;
+        keys[i].row = i;
+    }
+}
+
+/* growable list of pairs, kept in a protected raw vector so that
+   nothing leaks if there's an error or interrupt */
+typedef struct {
+    SEXP vec;
+    PROTECT_INDEX ipx;
+    uint64_t *data;
+    size_t n, capacity;
+} pair_list;
+
+static void pair_list_init(pair_list *pl, size_t capacity)
+{
+    PROTECT_WITH_INDEX(pl->vec = allocVector(RAWSXP, capacity * sizeof(uint64_t)), &pl->ipx);
+    pl->data = (uint64_t *)RAW(pl->vec);
+    pl->n = 0;
+    pl->capacity = capacity;
+}
+
+/* add pair (i,j), i<j, coded as i*nrow + j */
+static void add_pair(pair_list *pl, int i, int j, int nrow)
+{
+    if(pl->n == pl->capacity) {
+        SEXP bigger = allocVector(RAWSXP, 2 * pl->capacity * sizeof(uint64_t));
+        memcpy(RAW(bigger), pl->data, pl->n * sizeof(uint64_t));
+        REPROTECT(pl->vec = bigger, pl->ipx);
+        pl->data = (uint64_t *)RAW(pl->vec);
+        pl->capacity *= 2;
+    }
+    pl->data[pl->n++] = (uint64_t)i * (uint64_t)nrow + (uint64_t)j;
+}
+
+/* add all pairs of rows that share a key; keys are sorted in place */
+static void lsh_bucket_pairs(lsh_key *keys, int nrow, pair_list *pl)
+{
+    int start, end, u, v;
+
+    qsort(keys, nrow, sizeof(lsh_key), compare_key);
+
+    for(start=0; start<nrow; start=end) {
+        for(end=start+1; end<nrow && keys[end].key == keys[start].key; end++);
+
+        /* rows are sorted within the bucket, so keys[u].row < keys[v].row */
+        for(u=start; u<end-1; u++)
+            for(v=u+1; v<end; v++)
+                add_pair(pl, keys[u].row, keys[v].row, nrow);
+    }
+}
+
+/**********************************************************************
+ * compare_rows_lsh
+ *
+ * tmat is ncol x nrow (so each row of the original matrix is
+ * contiguous): int for method=1, double for method=2
+ *
+ * method=1: cols is n_bits x n_tables, 0-based column indices
+ * method=2: seeds is 6 x n_tables, one random number stream per table
+ *
+ * Returns a raw vector (unprotected) whose first *n_pairs elements,
+ * viewed as uint64_t, are the unique candidate pairs (coded as
+ * i*nrow + j, sorted)
+ *
+ **********************************************************************/
+SEXP compare_rows_lsh(const void *tmat, int nrow, int ncol, int method,
+                      int n_bits, int n_tables, const int *cols,
+                      double width, const int *seeds,
+                      size_t *n_pairs, int n_threads)
+{
+    int t, b, k, i;
+    size_t j;
+    pair_list pl;
+    lsh_key *keys = (lsh_key *)R_alloc(nrow, sizeof(lsh_key));
+    double *colmean = NULL, *proj = NULL, *offset = NULL;
+    int *n_obs;
+
+    if(method == 2) {
+        const double *x = (const double *)tmat;
+
+        colmean = (double *)R_alloc(ncol, sizeof(double));
+        n_obs = (int *)R_alloc(ncol, sizeof(int));
+        for(k=0; k<ncol; k++) { colmean[k] = 0.0; n_obs[k] = 0; }
+        for(i=0; i<nrow; i++) {
+            for(k=0; k<ncol; k++) {
+                if(!ISNAN(x[(size_t)i*ncol + k])) {
+                    colmean[k] += x[(size_t)i*ncol + k];
+                    n_obs[k]++;
+                }
+            }
+        }
+        for(k=0; k<ncol; k++) colmean[k] = (n_obs[k] > 0 ? colmean[k]/(double)n_obs[k] : 0.0);
+
+        proj = (double *)R_alloc((size_t)n_bits * (size_t)ncol, sizeof(double));
+        offset = (double *)R_alloc(n_bits, sizeof(double));
+    }
+
+    pair_list_init(&pl, nrow > 16 ? nrow : 16);
+
+    for(t=0; t<n_tables; t++) {
+        R_CheckUserInterrupt(); /* check for ^C */
+
+        if(method == 1) {
+            lsh_keys_mismatch((const int *)tmat, nrow, ncol, cols + (size_t)t*n_bits,
+                              n_bits, keys, n_threads);
+        }
+        else {
+            rng_stream g;
+            rng_stream_set(&g, seeds + 6*t);
+            for(b=0; b<n_bits; b++) {
+                for(k=0; k<ncol; k++) proj[(size_t)b*ncol + k] = rng_stream_norm(&g);
+                offset[b] = rng_stream_unif(&g) * width;
+            }
+
+            lsh_keys_rmsd((const double *)tmat, nrow, ncol, colmean, proj, offset,
+                          n_bits, width, keys, n_threads);
+        }
+
+        lsh_bucket_pairs(keys, nrow, &pl);
+
+        /* drop duplicates as we go, to keep the list from growing with n_tables */
+        qsort(pl.data, pl.n, sizeof(uint64_t), compare_uint64);
+        if(pl.n > 0) {
+            size_t n_unique = 1;
+            for(j=1; j < pl.n; j++)
+                if(pl.data[j] != pl.data[n_unique-1]) pl.data[n_unique++] = pl.data[j];
+            pl.n = n_unique;
+        }
+    }
+
+    *n_pairs = pl.n;
+    UNPROTECT(1);
+    return pl.vec;
+}
+
+/**********************************************************************
+ * R_compare_rows_lsh_prep
+ *
+ * In one pass through mat (nrow x ncol, integer, logical or double),
+ * form its transpose, as integer for method=1 or double for method=2,
+ * and get the number of non-missing values in each column and, for
+ * method=2, the column variances (0 if fewer than two values)
+ *
+ * returns list(tmat, n_obs, var), with var NULL for method=1
+ **********************************************************************/
+SEXP R_compare_rows_lsh_prep(SEXP mat, SEXP method)
+{
+    int nrow = nrows(mat), ncol = ncols(mat);
+    int meth = asInteger(method);
+    int is_int = (TYPEOF(mat) == INTSXP || TYPEOF(mat) == LGLSXP);
+    int i, j, *n_obs;
+    double x, mean, m2, delta, *var=NULL;
+    SEXP result, tmat, obs, v;
+
+    if(!is_int && TYPEOF(mat) != REALSXP)
+        error("mat should be numeric");
+
+    PROTECT(result = allocVector(VECSXP, 3));
+    PROTECT(tmat = allocMatrix(meth==1 ? INTSXP : REALSXP, ncol, nrow));
+    PROTECT(obs = allocVector(INTSXP, ncol));
+    if(meth==2) {
+        PROTECT(v = allocVector(REALSXP, ncol));
+        var = REAL(v);
+    }
+    else PROTECT(v = R_NilValue);
+    n_obs = INTEGER(obs);
+
+    const int *mi = (is_int ? INTEGER(mat) : NULL);
+    const double *md = (is_int ? NULL : REAL(mat));
+    int *ti = (meth==1 ? INTEGER(tmat) : NULL);
+    double *td = (meth==1 ? NULL : REAL(tmat));
+
+    for(j=0; j<ncol; j++) {
+        n_obs[j] = 0;
+        mean = m2 = 0.0;
+
+        for(i=0; i<nrow; i++) {
+            size_t from = (size_t)i + (size_t)j*nrow, to = (size_t)j + (size_t)i*ncol;
+
+            if(is_int) {
+                if(mi[from] == NA_INTEGER) x = NA_REAL;
+                else x = (double)mi[from];
+            }
+            else x = md[from];
+
+            if(meth==1) {
+                if(is_int) ti[to] = mi[from];
+                else if(ISNAN(x) || x >= 2147483648.0 || x <= -2147483648.0)
+                    ti[to] = NA_INTEGER; /* as in as.integer() */
+                else ti[to] = (int)x;
+
+                if(ti[to] != NA_INTEGER) n_obs[j]++;
+            }
+            else {
+                td[to] = x;
+                if(!ISNAN(x)) { /* running mean and sum of squares (Welford) */
+                    n_obs[j]++;
+                    delta = x - mean;
+                    mean += delta / (double)n_obs[j];
+                    m2 += delta * (x - mean);
+                }
+            }
+        }
+
+        if(meth==2) var[j] = (n_obs[j] > 1 ? m2 / (double)(n_obs[j] - 1) : 0.0);
+    }
+
+    SET_VECTOR_ELT(result, 0, tmat);
+    SET_VECTOR_ELT(result, 1, obs);
+    SET_VECTOR_ELT(result, 2, v);
+
+    UNPROTECT(4);
+    return result;
+}
+
+/* R wrapper
+   returns list(row1, row2, value, n_candidates) with the candidate pairs
+   having value <= threshold; row1 and row2 are 1-based */
+SEXP R_compare_rows_lsh(SEXP tmat, SEXP method, SEXP n_bits, SEXP cols,
+                        SEXP width, SEXP seeds, SEXP threshold, SEXP cores)
+{
+    int ncol = nrows(tmat), nrow = ncols(tmat);
+    int meth = asInteger(method), nb = asInteger(n_bits);
+    int n_threads = asInteger(cores);
+    int n_tables = (meth==1 ? ncols(cols) : ncols(seeds));
+    double thresh = asReal(threshold);
+    uint64_t *pairs;
+    size_t n_pairs, j, n_close;
+    double *value;
+    SEXP pair_vec, result, row1, row2, val;
+    int64_t jj;
+
+    PROTECT(pair_vec = compare_rows_lsh(meth==1 ? (const void *)INTEGER(tmat) : (const void *)REAL(tmat),
+                                        nrow, ncol, meth, nb, n_tables,
+                                        meth==1 ? INTEGER(cols) : NULL,
+                                        meth==1 ? 0.0 : asReal(width),
+                                        meth==1 ? NULL : INTEGER(seeds),
+                                        &n_pairs, n_threads));
+    pairs = (uint64_t *)RAW(pair_vec);
+
+    /* exact comparison of the candidate pairs */
+    const int *imat = (meth==1 ? INTEGER(tmat) : NULL);
+    const double *dmat = (meth==1 ? NULL : REAL(tmat));
+    value = (double *)R_alloc(n_pairs > 0 ? n_pairs : 1, sizeof(double));
+
+    #pragma omp parallel for num_threads(n_threads) schedule(dynamic, 1024)
+    for(jj=0; jj<(int64_t)n_pairs; jj++) {
+        int i1 = (int)(pairs[jj] / (uint64_t)nrow), i2 = (int)(pairs[jj] % (uint64_t)nrow);
+        int n, ndiff;
+        double sumsq;
+
+        if(meth==1) {
+            simd_mismatch(imat + (size_t)i1*ncol, imat + (size_t)i2*ncol, ncol, &n, &ndiff);
+            value[jj] = (n==0 ? NA_REAL : (double)ndiff / (double)n);
+        }
+        else {
+            simd_rmsd(dmat + (size_t)i1*ncol, dmat + (size_t)i2*ncol, ncol, &n, &sumsq);
+            value[jj] = (n==0 ? NA_REAL : sqrt(sumsq / (double)n));
+        }
+    }
+
+    /* keep the pairs within the threshold; move them to the front */
+    n_close = 0;
+    for(j=0; j<n_pairs; j++) {
+        if(!ISNAN(value[j]) && value[j] <= thresh) {
+            pairs[n_close] = pairs[j];
+            value[n_close] = value[j];
+            n_close++;
+        }
+    }
+
+    PROTECT(result = allocVector(VECSXP, 4));
+    PROTECT(row1 = allocVector(INTSXP, n_close));
+    PROTECT(row2 = allocVector(INTSXP, n_close));
+    PROTECT(val = allocVector(REALSXP, n_close));
+
+    for(j=0; j<n_close; j++) {
+        INTEGER(row1)[j] = (int)(pairs[j] / (uint64_t)nrow) + 1;
+        INTEGER(row2)[j] = (int)(pairs[j] % (uint64_t)nrow) + 1;
+        REAL(val)[j] = value[j];
+    }
+
+    SET_VECTOR_ELT(result, 0, row1);
+    SET_VECTOR_ELT(result, 1, row2);
+    SET_VECTOR_ELT(result, 2, val);
+    SET_VECTOR_ELT(result, 3, ScalarReal((double)n_pairs));
+
+    UNPROTECT(5);
+    return result;
+}
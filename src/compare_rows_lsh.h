@@ -0,0 +1,37 @@
+/* compare_rows_lsh.h
+
+   Karl W Broman
+
+   Find pairs of rows in a matrix that are close, by proportion of
+   mismatches or RMS difference, using locality-sensitive hashing to
+   generate candidate pairs that are then checked exactly
+
+*/
+
+#ifndef BROMAN_COMPARE_ROWS_LSH_H
+#define BROMAN_COMPARE_ROWS_LSH_H
+
+#include <stdint.h>
+
+/* candidate pairs of rows (coded as i*nrow + j, i<j, sorted and unique)
+   that share a hash key in at least one of n_tables hash tables,
+   returned as the first *n_pairs uint64_t's of a raw vector
+
+   tmat is ncol x nrow (rows of the original matrix contiguous)
+   method=1: bit sampling, with cols the n_bits x n_tables column indices
+   method=2: random projections, with seeds 6 x n_tables */
+SEXP compare_rows_lsh(const void *tmat, int nrow, int ncol, int method,
+                      int n_bits, int n_tables, const int *cols,
+                      double width, const int *seeds,
+                      size_t *n_pairs, int n_threads);
+
+/* transpose mat, as integer (method=1) or double (method=2), and get
+   the number of non-missing values in each column and, for method=2,
+   the column variances; returns list(tmat, n_obs, var) */
+SEXP R_compare_rows_lsh_prep(SEXP mat, SEXP method);
+
+/* R wrapper */
+SEXP R_compare_rows_lsh(SEXP tmat, SEXP method, SEXP n_bits, SEXP cols,
+                        SEXP width, SEXP seeds, SEXP threshold, SEXP cores);
+
+#endif // BROMAN_COMPARE_ROWS_LSH_H
@@ -5,21 +5,16 @@
 #include <math.h>
 #include <stdlib.h>
 #include "count_close.h"
+#include "simd.h"
 
 void count_close(double *values, int n_values, double tol, int *counts)
 {
-    int i, j;
+    int i;
 
     /* assume counts initialized at 0 */
 
-    for(i=0; i<n_values-1; i++) {
-        for(j=i+1; j<n_values; j++) {
-            if(fabs(values[i] - values[j]) <= tol) {
-                counts[i]++;
-                counts[j]++;
-            }
-        }
-    }
+    for(i=0; i<n_values-1; i++)
+        counts[i] += simd_close(values+i+1, n_values-i-1, values[i], tol, counts+i+1);
 }
 
 void R_count_close(double *values, int *n_values, double *tol, int *counts)
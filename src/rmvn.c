@@ -0,0 +1,206 @@
+/**********************************************************************
+ *
+ * rmvn.c
+ *
+ * copyright (c) 2026, Karl W Broman
+ *
+ *     This program is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License,
+ *     version 3, as published by the Free Software Foundation.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but without any warranty; without even the implied warranty of
+ *     merchantability or fitness for a particular purpose.  See the GNU
+ *     General Public License, version 3, for more details.
+ *
+ *     A copy of the GNU General Public License, version 3, is available
+ *     at https://www.r-project.org/Licenses/GPL-3
+ *
+ * C functions for the R/broman package
+ *
+ * Simulate from a multivariate normal distribution, writing into
+ * a preallocated n x p matrix and transforming it in place in
+ * cache-sized blocks of rows
+ *
+ * Contains: rmvn_chol_block, rmvn_cs_block, rmvn, R_rmvn
+ *
+ **********************************************************************/
+
+#include <math.h>
+#include <stdlib.h>
+#include <R.h>
+#include <Rinternals.h>
+#include <Rmath.h>
+#include <R_ext/Utils.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "rmvn.h"
+#include "rng_streams.h"
+
+/* aim for a block of rows to take about 256 KB */
+#define RMVN_BLOCK_DOUBLES 32768
+
+static int rmvn_block_size(int p)
+{
+    int b = RMVN_BLOCK_DOUBLES / p;
+    return (b < 16 ? 16 : b);
+}
+
+/**********************************************************************
+ * rmvn_chol_block
+ *
+ * rows i0, ..., i1-1 of the n x p matrix X (column-major) contain iid
+ * N(0,1); replace them with X %*% D + mu, where D is the p x p upper
+ * triangular Cholesky factor
+ *
+ * Columns are done from last to first, so that column j can be
+ * overwritten while columns 0..j-1 still hold the N(0,1) values.
+ *
+ **********************************************************************/
+void rmvn_chol_block(int n, int p, double *X, const double *D,
+                     const double *mu, int i0, int i1)
+{
+    int i, j, k;
+    double d, *xj;
+    const double *xk;
+
+    for(j=p-1; j>=0; j--) {
+        xj = X + (size_t)j*n;
+
+        d = D[j + (size_t)j*p];
+        for(i=i0; i<i1; i++) xj[i] *= d;
+
+        for(k=0; k<j; k++) {
+            d = D[k + (size_t)j*p];
+            if(d == 0.0) continue;
+            xk = X + (size_t)k*n;
+            for(i=i0; i<i1; i++) xj[i] += d*xk[i];
+        }
+
+        d = mu[j];
+        for(i=i0; i<i1; i++) xj[i] += d;
+    }
+}
+
+/**********************************************************************
+ * rmvn_cs_block
+ *
+ * As rmvn_chol_block, but for compound symmetry: variances 1 and
+ * all correlations rho. With zbar the row mean, the rows of
+ * sqrt(1-rho) (Z - c zbar) have that covariance, where
+ * c = 1 - sqrt((1 + (p-1) rho)/(1-rho)), so it takes O(p) per row.
+ *
+ * work has space for i1-i0 doubles
+ *
+ **********************************************************************/
+void rmvn_cs_block(int n, int p, double *X, double rho,
+                   const double *mu, int i0, int i1, double *work)
+{
+    int i, j, nb=i1-i0;
+    double s, c, *xj;
+
+    s = sqrt(1.0 - rho);
+    c = 1.0 - sqrt((1.0 + (double)(p-1)*rho)/(1.0 - rho));
+
+    for(i=0; i<nb; i++) work[i] = 0.0;
+    for(j=0; j<p; j++) {
+        xj = X + (size_t)j*n + i0;
+        for(i=0; i<nb; i++) work[i] += xj[i];
+    }
+    for(i=0; i<nb; i++) work[i] *= (c/(double)p);
+
+    for(j=0; j<p; j++) {
+        xj = X + (size_t)j*n + i0;
+        for(i=0; i<nb; i++) xj[i] = s*(xj[i] - work[i]) + mu[j];
+    }
+}
+
+/**********************************************************************
+ * rmvn
+ *
+ * Fill n x p matrix X with multivariate normal draws, mean mu.
+ * If D is non-NULL, it's the upper-triangular Cholesky factor of
+ * the variance matrix; otherwise compound symmetry with correlation rho.
+ *
+ * If n_streams == 0, use R's RNG, drawing the N(0,1) values in the
+ * same order as matrix(rnorm(n*p), ncol=p). Otherwise, split the rows
+ * into n_streams chunks, each with its own L'Ecuyer-CMRG stream
+ * (seeds is 6 x n_streams), and generate them in parallel.
+ *
+ **********************************************************************/
+void rmvn(int n, int p, double *X, const double *D, double rho,
+          const double *mu, int n_streams, const int *seeds)
+{
+    int b = rmvn_block_size(p);
+
+    if(n_streams == 0) {
+        size_t i, np = (size_t)n * (size_t)p;
+        int i0, i1;
+        double *work = NULL;
+
+        GetRNGstate();
+        for(i=0; i<np; i++) X[i] = norm_rand();
+        PutRNGstate();
+
+        if(D == NULL) work = (double *)R_alloc(b, sizeof(double));
+
+        for(i0=0; i0<n; i0+=b) {
+            R_CheckUserInterrupt(); /* check for ^C */
+
+            i1 = (i0 + b < n ? i0 + b : n);
+            if(D != NULL) rmvn_chol_block(n, p, X, D, mu, i0, i1);
+            else rmvn_cs_block(n, p, X, rho, mu, i0, i1, work);
+        }
+        return;
+    }
+
+    /* allocate workspace here; can't call R_alloc within threads */
+    double *work = NULL;
+    if(D == NULL) work = (double *)R_alloc((size_t)b * (size_t)n_streams, sizeof(double));
+
+    int chunk = n / n_streams + (n % n_streams > 0);
+
+    int t;
+    #pragma omp parallel for num_threads(n_streams) schedule(static, 1)
+    for(t=0; t<n_streams; t++) {
+        rng_stream g;
+        int i, j, i0, i1;
+        int start = t*chunk, end = (t+1)*chunk;
+        if(end > n) end = n;
+
+        rng_stream_set(&g, seeds + 6*t);
+
+        for(i0=start; i0<end; i0+=b) {
+            i1 = (i0 + b < end ? i0 + b : end);
+
+            for(j=0; j<p; j++) {
+                double *xj = X + (size_t)j*n;
+                for(i=i0; i<i1; i++) xj[i] = rng_stream_norm(&g);
+            }
+
+            if(D != NULL) rmvn_chol_block(n, p, X, D, mu, i0, i1);
+            else rmvn_cs_block(n, p, X, rho, mu, i0, i1, work + (size_t)b*t);
+        }
+    }
+}
+
+/* wrapper for R */
+SEXP R_rmvn(SEXP n, SEXP mu, SEXP D, SEXP rho, SEXP seeds)
+{
+    int n_rep = asInteger(n);
+    int p = LENGTH(mu);
+    int n_streams = (isNull(seeds) ? 0 : ncols(seeds));
+    SEXP result;
+
+    PROTECT(result = allocMatrix(REALSXP, n_rep, p));
+
+    rmvn(n_rep, p, REAL(result),
+         isNull(D) ? NULL : REAL(D), asReal(rho), REAL(mu),
+         n_streams, isNull(seeds) ? NULL : INTEGER(seeds));
+
+    UNPROTECT(1);
+    return result;
+}
+
+/* end of rmvn.c */
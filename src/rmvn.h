@@ -0,0 +1,65 @@
+/**********************************************************************
+ *
+ * rmvn.h
+ *
+ * copyright (c) 2026, Karl W Broman
+ *
+ *     This program is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License,
+ *     version 3, as published by the Free Software Foundation.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but without any warranty; without even the implied warranty of
+ *     merchantability or fitness for a particular purpose.  See the GNU
+ *     General Public License, version 3, for more details.
+ *
+ *     A copy of the GNU General Public License, version 3, is available
+ *     at https://www.r-project.org/Licenses/GPL-3
+ *
+ * C functions for the R/broman package
+ *
+ * Simulate from a multivariate normal distribution, writing into
+ * a preallocated n x p matrix and transforming it in place in
+ * cache-sized blocks of rows
+ *
+ * Contains: rmvn_chol_block, rmvn_cs_block, rmvn, R_rmvn
+ *
+ **********************************************************************/
+
+/**********************************************************************
+ * rmvn_chol_block
+ *
+ * rows i0, ..., i1-1 of the n x p matrix X (column-major) contain iid
+ * N(0,1); replace them with X %*% D + mu, where D is the p x p upper
+ * triangular Cholesky factor
+ *
+ **********************************************************************/
+void rmvn_chol_block(int n, int p, double *X, const double *D,
+                     const double *mu, int i0, int i1);
+
+/**********************************************************************
+ * rmvn_cs_block
+ *
+ * As rmvn_chol_block, but for compound symmetry: variances 1 and
+ * all correlations rho
+ *
+ **********************************************************************/
+void rmvn_cs_block(int n, int p, double *X, double rho,
+                   const double *mu, int i0, int i1, double *work);
+
+/**********************************************************************
+ * rmvn
+ *
+ * Fill n x p matrix X with multivariate normal draws, mean mu.
+ * If D is non-NULL, it's the upper-triangular Cholesky factor of
+ * the variance matrix; otherwise compound symmetry with correlation rho.
+ * If n_streams > 0, use that many L'Ecuyer-CMRG streams in parallel.
+ *
+ **********************************************************************/
+void rmvn(int n, int p, double *X, const double *D, double rho,
+          const double *mu, int n_streams, const int *seeds);
+
+/* wrapper for R */
+SEXP R_rmvn(SEXP n, SEXP mu, SEXP D, SEXP rho, SEXP seeds);
+
+/* end of rmvn.h */
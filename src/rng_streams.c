@@ -0,0 +1,74 @@
+/* rng_streams.c
+
+   Karl W Broman
+
+   L'Ecuyer-CMRG (MRG32k3a) random number streams, for generating
+   random numbers within threads, where R's RNG can't be used.
+
+   The generator follows the L'Ecuyer-CMRG code in R's RNG.c, and
+   normal deviates use inversion (with two uniforms per deviate), as
+   R does by default.
+
+*/
+
+#include <math.h>
+#include <stdint.h>
+#include <R.h>
+#include <Rmath.h>
+#include "rng_streams.h"
+
+#define m1    4294967087
+#define m2    4294944443
+#define normc 2.328306549295727688e-10
+#define a12   (int_least64_t)1403580
+#define a13n  (int_least64_t)810728
+#define a21   (int_least64_t)527612
+#define a23n  (int_least64_t)1370589
+
+#define i2_32m1 2.328306437080797e-10 /* = 1/(2^32 - 1) */
+#define BIG 134217728 /* 2^27 */
+
+void rng_stream_set(rng_stream *g, const int *seed)
+{
+    int i;
+
+    for(i=0; i<6; i++) g->s[i] = (unsigned int)seed[i];
+}
+
+double rng_stream_unif(rng_stream *g)
+{
+    int_least64_t k, p1, p2;
+    double value;
+
+    p1 = a12 * (int_least64_t)g->s[1] - a13n * (int_least64_t)g->s[0];
+    k = p1 / m1;  p1 -= k * m1;  if(p1 < 0) p1 += m1;
+    g->s[0] = g->s[1]; g->s[1] = g->s[2]; g->s[2] = (unsigned int)p1;
+
+    p2 = a21 * (int_least64_t)g->s[5] - a23n * (int_least64_t)g->s[3];
+    k = p2 / m2;  p2 -= k * m2;  if(p2 < 0) p2 += m2;
+    g->s[3] = g->s[4]; g->s[4] = g->s[5]; g->s[5] = (unsigned int)p2;
+
+    value = ((p1 > p2) ? (p1 - p2) : (p1 - p2 + m1)) * normc;
+
+    /* ensure in (0,1), as in R's fixup() */
+    if(value <= 0.0) return 0.5*i2_32m1;
+    if(1.0 - value <= 0.0) return 1.0 - 0.5*i2_32m1;
+    return value;
+}
+
+double rng_stream_norm(rng_stream *g)
+{
+    double u;
+
+    u = rng_stream_unif(g);
+    u = (int)(BIG*u) + rng_stream_unif(g);
+    return qnorm5(u/BIG, 0.0, 1.0, 1, 0);
+}
+
+int rng_stream_index(rng_stream *g, int n)
+{
+    int result = (int)(rng_stream_unif(g) * (double)n);
+
+    if(result >= n) result = n-1;
+    return result;
+}
@@ -0,0 +1,40 @@
+/* rng_streams.h
+
+   Karl W Broman
+
+   L'Ecuyer-CMRG (MRG32k3a) random number streams, for generating
+   random numbers within threads, where R's RNG can't be used.
+   Each stream is seeded from a column of the matrix produced by
+   rng_stream_seeds() in R, which uses parallel::nextRNGStream(),
+   so the streams don't overlap.
+
+*/
+
+#ifndef BROMAN_RNG_STREAMS_H
+#define BROMAN_RNG_STREAMS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    unsigned int s[6];
+} rng_stream;
+
+/* set the state from six integers (as in .Random.seed[2:7]) */
+void rng_stream_set(rng_stream *g, const int *seed);
+
+/* uniform on (0,1); same algorithm as R's L'Ecuyer-CMRG */
+double rng_stream_unif(rng_stream *g);
+
+/* standard normal by inversion, as R's default norm_rand() */
+double rng_stream_norm(rng_stream *g);
+
+/* random integer in 0, 1, ..., n-1 */
+int rng_stream_index(rng_stream *g, int n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BROMAN_RNG_STREAMS_H
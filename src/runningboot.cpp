@@ -0,0 +1,313 @@
+/**********************************************************************
+ *
+ * runningboot.cpp
+ *
+ * copyright (c) 2026, Karl W Broman
+ *
+ *     This program is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License,
+ *     version 3, as published by the Free Software Foundation.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but without any warranty; without even the implied warranty of
+ *     merchantability or fitness for a particular purpose.  See the GNU
+ *     General Public License, version 3, for more details.
+ *
+ *     A copy of the GNU General Public License, version 3, is available
+ *     at https://www.r-project.org/Licenses/GPL-3
+ *
+ * C++ functions for the R/broman package
+ *
+ * Block bootstrap confidence bands for the running mean/sum/sd and
+ * running ratio, using the same windows as runningmean() and
+ * runningratio()
+ *
+ * Each bootstrap replicate is a circular block bootstrap: m = ceil(n/L)
+ * blocks of L consecutive points, with the starts sampled uniformly
+ * and blocks wrapping around the end. A replicate is stored only as
+ * its sorted block starts; the weight (number of copies) of point j
+ * is then
+ *
+ *     A(j) - A(j-L) + m - A(j+n-L)
+ *
+ * where A(x) = number of starts <= x, the last term counting the
+ * wrapped pieces. As the window slides, each point is added to or
+ * removed from per-replicate sums with that weight, so all replicates
+ * are evaluated in one pass over the data, with the windows from
+ * window_bounds() in runningwindow.h, as in runningmean.cpp.
+ *
+ * Contains: runningboot_starts, runningboot, R_runningboot
+ *
+ **********************************************************************/
+
+#include <math.h>
+#include <stdlib.h>
+#include <R.h>
+#include <Rmath.h>
+#include <R_ext/Utils.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "runningboot.h"
+#include "runningwindow.h"
+#include "rng_streams.h"
+
+/* number of values in sorted x[0..m-1] that are <= value */
+static int count_le(const int *x, int m, int value)
+{
+    int lo=0, hi=m, mid;
+
+    while(lo < hi) {
+        mid = (lo+hi)/2;
+        if(x[mid] <= value) lo = mid+1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static int compare_int(const void *a, const void *b)
+{
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/**********************************************************************
+ * runningboot_starts
+ *
+ * Sample sorted block starts for n_boot replicates, m per replicate,
+ * each in 0..n-1; starts is n_boot x m (row b = replicate b)
+ *
+ * If n_streams == 0, use R's RNG; otherwise, split the replicates
+ * into chunks with separate L'Ecuyer-CMRG streams (seeds is 6 x n_streams)
+ *
+ **********************************************************************/
+void runningboot_starts(int n, int m, int n_boot, int *starts,
+                        int n_streams, const int *seeds)
+{
+    int b, k;
+
+    if(n_streams == 0) {
+        GetRNGstate();
+        for(b=0; b<n_boot; b++) {
+            int *st = starts + (size_t)b*m;
+            for(k=0; k<m; k++) {
+                st[k] = (int)(unif_rand() * (double)n);
+                if(st[k] >= n) st[k] = n-1;
+            }
+        }
+        PutRNGstate();
+
+        for(b=0; b<n_boot; b++)
+            qsort(starts + (size_t)b*m, m, sizeof(int), compare_int);
+        return;
+    }
+
+    int chunk = n_boot / n_streams + (n_boot % n_streams > 0);
+    int t;
+    #pragma omp parallel for num_threads(n_streams) schedule(static, 1)
+    for(t=0; t<n_streams; t++) {
+        rng_stream g;
+        int bb, kk, end = (t+1)*chunk;
+        if(end > n_boot) end = n_boot;
+
+        rng_stream_set(&g, seeds + 6*t);
+
+        for(bb=t*chunk; bb<end; bb++) {
+            int *st = starts + (size_t)bb*m;
+            for(kk=0; kk<m; kk++) st[kk] = rng_stream_index(&g, n);
+            qsort(st, m, sizeof(int), compare_int);
+        }
+    }
+}
+
+/* weight of point j in a replicate, with pointers ptr[0..2] into the
+   sorted starts; ptr only move forward, so j must be non-decreasing */
+static inline int boot_weight(const int *st, int m, int L, int n, int j, int *ptr)
+{
+    while(ptr[0] < m && st[ptr[0]] <= j) ptr[0]++;
+    while(ptr[1] < m && st[ptr[1]] <= j - L) ptr[1]++;
+    while(ptr[2] < m && st[ptr[2]] <= j + n - L) ptr[2]++;
+
+    return ptr[0] - ptr[1] + m - ptr[2];
+}
+
+static void boot_weight_init(const int *st, int m, int L, int n, int j, int *ptr)
+{
+    ptr[0] = count_le(st, m, j-1);
+    ptr[1] = count_le(st, m, j-1-L);
+    ptr[2] = count_le(st, m, j-1+n-L);
+}
+
+/* quantiles (as type 7 in R) of the non-missing values in x[0..n-1];
+   x is sorted in place */
+static void boot_quantiles(double *x, int n, const double *probs, int n_probs,
+                           double *result, int n_result)
+{
+    int i, k, lo;
+    double h;
+
+    /* move the missing values to the end */
+    for(i=0, k=0; i<n; i++)
+        if(!ISNAN(x[i])) x[k++] = x[i];
+    n = k;
+
+    if(n==0) {
+        for(k=0; k<n_probs; k++) result[(size_t)k*n_result] = NA_REAL;
+        return;
+    }
+
+    qsort(x, n, sizeof(double), compare_double);
+
+    for(k=0; k<n_probs; k++) {
+        h = (double)(n-1) * probs[k];
+        lo = (int)floor(h);
+        if(lo >= n-1) result[(size_t)k*n_result] = x[n-1];
+        else result[(size_t)k*n_result] = x[lo] + (h - (double)lo)*(x[lo+1] - x[lo]);
+    }
+}
+
+/**********************************************************************
+ * runningboot
+ *
+ * Bootstrap quantiles of running statistic within a window
+ *
+ * method = 1 -> sum
+ *        = 2 -> mean
+ *        = 4 -> sd
+ *        = 5 -> ratio sum(value)/sum(value2)
+ *
+ * We assume that pos and resultpos are both sorted (lo to high)
+ *
+ * result is n_result x n_probs
+ *
+ * starts are as from runningboot_starts(), n_boot x m; the result
+ * positions are split into n_threads chunks done in parallel
+ *
+ **********************************************************************/
+void runningboot(int n, double *pos, double *value, double *value2,
+                 int n_result, double *resultpos, double window, int method,
+                 int n_boot, int L, int m, const int *starts,
+                 int n_probs, double *probs, double *result, int n_threads)
+{
+    double *work;
+    int *ptr_work;
+    double sum_scale = (double)n / ((double)m * (double)L);
+    double center = 0.0;
+    int k;
+
+    window /= 2.0;
+
+    /* for SD, center the values to reduce round-off in the running sums */
+    if(method==4) {
+        for(k=0; k<n; k++) center += value[k];
+        center /= (double)n;
+    }
+
+    /* workspace for each thread: sums (3), statistic (1), pointers (6) */
+    work = (double *)R_alloc((size_t)n_threads * (size_t)n_boot * 4, sizeof(double));
+    ptr_work = (int *)R_alloc((size_t)n_threads * (size_t)n_boot * 6, sizeof(int));
+
+    int chunk = n_result / n_threads + (n_result % n_threads > 0);
+    int t;
+    #pragma omp parallel for num_threads(n_threads) schedule(static, 1)
+    for(t=0; t<n_threads; t++) {
+        int i, j, b, w, lo, hi, new_lo, new_hi;
+        int r0 = t*chunk, r1 = (t+1)*chunk;
+        double *s0 = work + (size_t)t*n_boot*4;
+        double *s1 = s0 + n_boot, *s2 = s1 + n_boot, *stat = s2 + n_boot;
+        int *hi_ptr = ptr_work + (size_t)t*n_boot*6, *lo_ptr = hi_ptr + (size_t)n_boot*3;
+        double x, y;
+
+        if(r1 > n_result) r1 = n_result;
+
+        lo = hi = n; /* empty window; reset at first position */
+        for(i=r0; i<r1; i++) {
+
+            /* find window [new_lo, new_hi) */
+            if(i==r0) new_lo = new_hi = 0;
+            else { new_lo = lo; new_hi = hi; }
+            window_bounds(pos, n, resultpos[i]-window, resultpos[i]+window, new_lo, new_hi);
+
+            if(i==r0 || new_lo >= hi) { /* no overlap with previous window: start fresh */
+                lo = hi = new_lo;
+                for(b=0; b<n_boot; b++) {
+                    s0[b] = s1[b] = s2[b] = 0.0;
+                    boot_weight_init(starts + (size_t)b*m, m, L, n, lo, hi_ptr + 3*b);
+                    boot_weight_init(starts + (size_t)b*m, m, L, n, lo, lo_ptr + 3*b);
+                }
+            }
+
+            /* add points entering the window */
+            for(j=hi; j<new_hi; j++) {
+                x = value[j] - center;
+                y = (method==5 ? value2[j] : x*x);
+                for(b=0; b<n_boot; b++) {
+                    w = boot_weight(starts + (size_t)b*m, m, L, n, j, hi_ptr + 3*b);
+                    if(w==0) continue;
+                    s0[b] += (double)w;
+                    s1[b] += (double)w * x;
+                    s2[b] += (double)w * y;
+                }
+            }
+
+            /* remove points leaving the window */
+            for(j=lo; j<new_lo; j++) {
+                x = value[j] - center;
+                y = (method==5 ? value2[j] : x*x);
+                for(b=0; b<n_boot; b++) {
+                    w = boot_weight(starts + (size_t)b*m, m, L, n, j, lo_ptr + 3*b);
+                    if(w==0) continue;
+                    s0[b] -= (double)w;
+                    s1[b] -= (double)w * x;
+                    s2[b] -= (double)w * y;
+                }
+            }
+            lo = new_lo;
+            hi = new_hi;
+
+            /* statistic for each replicate */
+            for(b=0; b<n_boot; b++) {
+                if(s0[b] < 0.5 || (method==4 && s0[b] < 1.5)) stat[b] = NA_REAL;
+                else if(method==1) stat[b] = s1[b] * sum_scale;
+                else if(method==2) stat[b] = s1[b] / s0[b];
+                else if(method==5) stat[b] = s1[b] / s2[b];
+                else { /* SD */
+                    x = (s2[b] - s1[b]*s1[b]/s0[b])/(s0[b]-1.0);
+                    stat[b] = (x < 0 ? 0.0 : sqrt(x)); /* threshold round-off error at 0 */
+                }
+            }
+
+            boot_quantiles(stat, n_boot, probs, n_probs, result + i, n_result);
+        }
+    }
+}
+
+/* wrapper for R */
+void R_runningboot(int *n, double *pos, double *value, double *value2,
+                   int *n_result, double *resultpos, double *window, int *method,
+                   int *n_boot, int *block, int *n_probs, double *probs,
+                   double *result, int *n_streams, int *seeds)
+{
+    int *starts;
+    int L = *block, m;
+
+    if(L > *n) L = *n;
+    m = *n / L + (*n % L > 0);
+
+    starts = (int *)R_alloc((size_t)(*n_boot) * (size_t)m, sizeof(int));
+    runningboot_starts(*n, m, *n_boot, starts, *n_streams, seeds);
+
+    R_CheckUserInterrupt(); /* check for ^C */
+
+    runningboot(*n, pos, value, value2, *n_result, resultpos, *window, *method,
+                *n_boot, L, m, starts, *n_probs, probs, result,
+                (*n_streams > 0 ? *n_streams : 1));
+}
+
+/* end of runningboot.cpp */
@@ -0,0 +1,69 @@
+/**********************************************************************
+ *
+ * runningboot.h
+ *
+ * copyright (c) 2026, Karl W Broman
+ *
+ *     This program is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License,
+ *     version 3, as published by the Free Software Foundation.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but without any warranty; without even the implied warranty of
+ *     merchantability or fitness for a particular purpose.  See the GNU
+ *     General Public License, version 3, for more details.
+ *
+ *     A copy of the GNU General Public License, version 3, is available
+ *     at https://www.r-project.org/Licenses/GPL-3
+ *
+ * C++ functions for the R/broman package
+ *
+ * Block bootstrap confidence bands for the running mean/sum/sd and
+ * running ratio, using the same windows as runningmean() and
+ * runningratio()
+ *
+ * Contains: runningboot_starts, runningboot, R_runningboot
+ *
+ **********************************************************************/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**********************************************************************
+ * runningboot_starts
+ *
+ * Sample sorted block starts for n_boot replicates, m per replicate,
+ * each in 0..n-1; starts is n_boot x m (row b = replicate b)
+ *
+ **********************************************************************/
+void runningboot_starts(int n, int m, int n_boot, int *starts,
+                        int n_streams, const int *seeds);
+
+/**********************************************************************
+ * runningboot
+ *
+ * Bootstrap quantiles of running statistic within a window
+ *
+ * method = 1 -> sum
+ *        = 2 -> mean
+ *        = 4 -> sd
+ *        = 5 -> ratio sum(value)/sum(value2)
+ *
+ **********************************************************************/
+void runningboot(int n, double *pos, double *value, double *value2,
+                 int n_result, double *resultpos, double window, int method,
+                 int n_boot, int L, int m, const int *starts,
+                 int n_probs, double *probs, double *result, int n_threads);
+
+/* wrapper for R */
+void R_runningboot(int *n, double *pos, double *value, double *value2,
+                   int *n_result, double *resultpos, double *window, int *method,
+                   int *n_boot, int *block, int *n_probs, double *probs,
+                   double *result, int *n_streams, int *seeds);
+
+#ifdef __cplusplus
+}
+#endif
+
+/* end of runningboot.h */
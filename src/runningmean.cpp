@@ -0,0 +1,315 @@
+/**********************************************************************
+ *
+ * runningmean.cpp
+ *
+ * copyright (c) 2006-2026, Karl W Broman
+ *
+ * last modified Oct, 2026
+ * first written Dec, 2006
+ *
+ *     This program is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License,
+ *     version 3, as published by the Free Software Foundation.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but without any warranty; without even the implied warranty of
+ *     merchantability or fitness for a particular purpose.  See the GNU
+ *     General Public License, version 3, for more details.
+ *
+ *     A copy of the GNU General Public License, version 3, is available
+ *     at https://www.r-project.org/Licenses/GPL-3
+ *
+ * C++ functions for the R/broman package
+ *
+ * This is for calculating a running mean/sum/median/sd.
+ * Also for calculating a running ratio.
+ *
+ * The kernels are templates, specialized at compile time on the
+ * statistic and on the types of the positions and values (int or
+ * double, following the R storage mode), so there are no per-element
+ * branches and integer positions needn't be converted to double.
+ *
+ * Contains: runningmean, R_runningmean, runningratio, R_runningratio
+ *
+ **********************************************************************/
+
+#include <R.h>
+#include <Rinternals.h>
+#include <Rmath.h>
+#include <R_ext/Utils.h>
+#include "runningmean.h"
+#include "runningwindow.h"
+
+namespace {
+
+/* sum of x[lo..hi-1], with four accumulators so the loop can be vectorized */
+template<typename Val>
+inline double window_sum(const Val *x, int lo, int hi)
+{
+    double s0=0.0, s1=0.0, s2=0.0, s3=0.0;
+    int j;
+
+    for(j=lo; j+4 <= hi; j+=4) {
+        s0 += (double)x[j];
+        s1 += (double)x[j+1];
+        s2 += (double)x[j+2];
+        s3 += (double)x[j+3];
+    }
+    for(; j<hi; j++) s0 += (double)x[j];
+
+    return (s0 + s1) + (s2 + s3);
+}
+
+/* sum of squares of x[lo..hi-1] */
+template<typename Val>
+inline double window_sumsq(const Val *x, int lo, int hi)
+{
+    double s0=0.0, s1=0.0, s2=0.0, s3=0.0, a;
+    int j;
+
+    for(j=lo; j+4 <= hi; j+=4) {
+        a = (double)x[j];   s0 += a*a;
+        a = (double)x[j+1]; s1 += a*a;
+        a = (double)x[j+2]; s2 += a*a;
+        a = (double)x[j+3]; s3 += a*a;
+    }
+    for(; j<hi; j++) {
+        a = (double)x[j];
+        s0 += a*a;
+    }
+
+    return (s0 + s1) + (s2 + s3);
+}
+
+/**********************************************************************
+ * statistics within a window [lo, hi)
+ *
+ * min_n = minimum number of values (otherwise the result is NA)
+ * work = workspace with room for hi-lo doubles (only for the median)
+ **********************************************************************/
+struct RunningSum {
+    static const int min_n = 1;
+    static const bool needs_work = false;
+
+    template<typename Val>
+    static double calc(const Val *x, int lo, int hi, double *)
+    {
+        return window_sum(x, lo, hi);
+    }
+};
+
+struct RunningMean {
+    static const int min_n = 1;
+    static const bool needs_work = false;
+
+    template<typename Val>
+    static double calc(const Val *x, int lo, int hi, double *)
+    {
+        return window_sum(x, lo, hi) / (double)(hi - lo);
+    }
+};
+
+struct RunningMedian {
+    static const int min_n = 1;
+    static const bool needs_work = true;
+
+    template<typename Val>
+    static double calc(const Val *x, int lo, int hi, double *work)
+    {
+        int j, ns = hi - lo;
+
+        for(j=0; j<ns; j++) work[j] = (double)x[lo+j];
+        R_rsort(work, ns);
+
+        if(ns % 2) return work[(ns-1)/2];
+        return (work[ns/2-1] + work[ns/2])/2.0; /* even */
+    }
+};
+
+struct RunningSD {
+    static const int min_n = 2;
+    static const bool needs_work = false;
+
+    template<typename Val>
+    static double calc(const Val *x, int lo, int hi, double *)
+    {
+        double ns = (double)(hi - lo);
+        double sum = window_sum(x, lo, hi);
+        double result = (window_sumsq(x, lo, hi) - sum*sum/ns)/(ns-1.0);
+
+        if(result < 0) return 0.0; /* handle potential round-off error by just thresholding to 0 */
+        return sqrt(result);
+    }
+};
+
+/**********************************************************************
+ * runningmean
+ *
+ * Get running statistic within a specified bp-width window
+ *
+ * We assume that pos and resultpos are both sorted (lo to high)
+ *
+ **********************************************************************/
+template<class Stat, typename Pos, typename Val>
+void runningmean(int n, const Pos *pos, const Val *value,
+                 int n_result, const double *resultpos, double *result,
+                 double window)
+{
+    int i, lo=0, hi=0;
+    double *work = NULL;
+
+    if(Stat::needs_work)
+        work = (double *)R_alloc(n > 0 ? n : 1, sizeof(double));
+
+    window /= 2.0;
+
+    for(i=0; i<n_result; i++) {
+        if(i % 1024 == 0) R_CheckUserInterrupt(); /* check for ^C */
+
+        window_bounds(pos, n, resultpos[i]-window, resultpos[i]+window, lo, hi);
+
+        if(hi - lo < Stat::min_n) result[i] = NA_REAL;
+        else result[i] = Stat::template calc<Val>(value, lo, hi, work);
+    }
+}
+
+/**********************************************************************
+ * runningratio
+ *
+ * Take sum(numerator)/sum(denominator) in sliding window
+ *
+ * We assume that pos and resultpos are sorted (lo to high)
+ **********************************************************************/
+template<typename Pos, typename Num, typename Den>
+void runningratio(int n, const Pos *pos, const Num *numerator, const Den *denominator,
+                  int n_result, const double *resultpos, double *result, double window)
+{
+    int i, lo=0, hi=0;
+
+    window /= 2.0;
+
+    for(i=0; i<n_result; i++) {
+        if(i % 1024 == 0) R_CheckUserInterrupt(); /* check for ^C */
+
+        window_bounds(pos, n, resultpos[i]-window, resultpos[i]+window, lo, hi);
+
+        if(hi == lo) result[i] = NA_REAL;
+        else result[i] = window_sum(numerator, lo, hi) / window_sum(denominator, lo, hi);
+    }
+}
+
+/* data pointer of the given type */
+template<typename T> const T *data_ptr(SEXP x);
+template<> const int *data_ptr<int>(SEXP x) { return INTEGER(x); }
+template<> const double *data_ptr<double>(SEXP x) { return REAL(x); }
+
+/* pick the instantiation from the storage mode of pos and value
+   (INTSXP -> int; otherwise REALSXP -> double) */
+template<class Stat, typename Pos>
+void runningmean_value(SEXP pos, SEXP value, SEXP resultpos, SEXP result, double window)
+{
+    const Pos *p = data_ptr<Pos>(pos);
+
+    if(TYPEOF(value) == INTSXP)
+        runningmean<Stat, Pos, int>(LENGTH(pos), p, INTEGER(value),
+                                    LENGTH(resultpos), REAL(resultpos), REAL(result), window);
+    else
+        runningmean<Stat, Pos, double>(LENGTH(pos), p, REAL(value),
+                                       LENGTH(resultpos), REAL(resultpos), REAL(result), window);
+}
+
+template<class Stat>
+void runningmean_pos(SEXP pos, SEXP value, SEXP resultpos, SEXP result, double window)
+{
+    if(TYPEOF(pos) == INTSXP)
+        runningmean_value<Stat, int>(pos, value, resultpos, result, window);
+    else
+        runningmean_value<Stat, double>(pos, value, resultpos, result, window);
+}
+
+template<typename Pos, typename Num>
+void runningratio_den(SEXP pos, SEXP numerator, SEXP denominator,
+                      SEXP resultpos, SEXP result, double window)
+{
+    const Pos *p = data_ptr<Pos>(pos);
+    const Num *num = data_ptr<Num>(numerator);
+
+    if(TYPEOF(denominator) == INTSXP)
+        runningratio<Pos, Num, int>(LENGTH(pos), p, num, INTEGER(denominator),
+                                    LENGTH(resultpos), REAL(resultpos), REAL(result), window);
+    else
+        runningratio<Pos, Num, double>(LENGTH(pos), p, num, REAL(denominator),
+                                       LENGTH(resultpos), REAL(resultpos), REAL(result), window);
+}
+
+template<typename Pos>
+void runningratio_num(SEXP pos, SEXP numerator, SEXP denominator,
+                      SEXP resultpos, SEXP result, double window)
+{
+    if(TYPEOF(numerator) == INTSXP)
+        runningratio_den<Pos, int>(pos, numerator, denominator, resultpos, result, window);
+    else
+        runningratio_den<Pos, double>(pos, numerator, denominator, resultpos, result, window);
+}
+
+} // namespace
+
+
+/**********************************************************************
+ * R_runningmean
+ *
+ * method = 1 -> sum
+ *        = 2 -> mean
+ *        = 3 -> median
+ *        = 4 -> sd
+ *
+ * pos and value should be integer or double; resultpos double
+ *
+ **********************************************************************/
+extern "C" SEXP R_runningmean(SEXP pos, SEXP value, SEXP resultpos,
+                              SEXP window, SEXP method)
+{
+    SEXP result;
+    double w = asReal(window);
+
+    PROTECT(result = allocVector(REALSXP, LENGTH(resultpos)));
+
+    switch(asInteger(method)) {
+    case 1: runningmean_pos<RunningSum>(pos, value, resultpos, result, w); break;
+    case 2: runningmean_pos<RunningMean>(pos, value, resultpos, result, w); break;
+    case 3: runningmean_pos<RunningMedian>(pos, value, resultpos, result, w); break;
+    case 4: runningmean_pos<RunningSD>(pos, value, resultpos, result, w); break;
+    default:
+        UNPROTECT(1);
+        error("invalid method");
+    }
+
+    UNPROTECT(1);
+    return result;
+}
+
+/**********************************************************************
+ * R_runningratio
+ *
+ * pos, numerator and denominator should be integer or double;
+ * resultpos double
+ *
+ **********************************************************************/
+extern "C" SEXP R_runningratio(SEXP pos, SEXP numerator, SEXP denominator,
+                               SEXP resultpos, SEXP window)
+{
+    SEXP result;
+    double w = asReal(window);
+
+    PROTECT(result = allocVector(REALSXP, LENGTH(resultpos)));
+
+    if(TYPEOF(pos) == INTSXP)
+        runningratio_num<int>(pos, numerator, denominator, resultpos, result, w);
+    else
+        runningratio_num<double>(pos, numerator, denominator, resultpos, result, w);
+
+    UNPROTECT(1);
+    return result;
+}
+
+/* end of runningmean.cpp */
@@ -2,9 +2,9 @@
  *
  * runningmean.h
  *
- * copyright (c) 2006-9, Karl W Broman
+ * copyright (c) 2006-2026, Karl W Broman
  *
- * last modified Nov, 2009
+ * last modified Oct, 2026
  * first written Dec, 2006
  *
  *     This program is free software; you can redistribute it and/or
@@ -19,45 +19,49 @@
  *     A copy of the GNU General Public License, version 3, is available
  *     at https://www.r-project.org/Licenses/GPL-3
  *
- * C functions for the R/broman package
+ * C++ functions for the R/broman package
  *
- * This is for calculating a running mean/sum/median.
+ * This is for calculating a running mean/sum/median/sd.
  * Also for calculating a running ratio.
  *
  * Contains: runningmean, R_runningmean, runningratio, R_runningratio
  *
  **********************************************************************/
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /**********************************************************************
- * runningmean
+ * R_runningmean
  *
- * Get running mean or sum within a specified bp-width window
+ * Get running mean, sum, median or sd within a specified bp-width window
  *
  * method = 1 -> sum
  *        = 2 -> mean
  *        = 3 -> median
+ *        = 4 -> sd
+ *
+ * pos and value should be integer or double; resultpos double
  *
  **********************************************************************/
-void runningmean(int n, double *pos, double *value, int n_result,
-                 double *resultpos, double *result,
-                 double window, int method);
-
-/* wrapper for R */
-void R_runningmean(int *n, double *pos, double *value, int *n_result,
-                   double *resultpos, double *result, double *window,
-                   int *method);
+SEXP R_runningmean(SEXP pos, SEXP value, SEXP resultpos,
+                   SEXP window, SEXP method);
 
 /**********************************************************************
- * runningratio
+ * R_runningratio
  *
  * Take sum(numerator)/sum(denominator) in sliding window
  *
+ * pos, numerator and denominator should be integer or double;
+ * resultpos double
+ *
  **********************************************************************/
-void runningratio(int n, double *pos, double *numerator, double *denominator,
-                  int n_result, double *resultpos, double *result, double window);
+SEXP R_runningratio(SEXP pos, SEXP numerator, SEXP denominator,
+                    SEXP resultpos, SEXP window);
 
-/* wrapper for R */
-void R_runningratio(int *n, double *pos, double *numerator, double *denominator,
-                    int *n_result, double *resultpos, double *result, double *window);
+#ifdef __cplusplus
+}
+#endif
 
 /* end of runningmean.h */
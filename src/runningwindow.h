@@ -0,0 +1,51 @@
+/**********************************************************************
+ *
+ * runningwindow.h
+ *
+ * copyright (c) 2006-2026, Karl W Broman
+ *
+ *     This program is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License,
+ *     version 3, as published by the Free Software Foundation.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but without any warranty; without even the implied warranty of
+ *     merchantability or fitness for a particular purpose.  See the GNU
+ *     General Public License, version 3, for more details.
+ *
+ *     A copy of the GNU General Public License, version 3, is available
+ *     at https://www.r-project.org/Licenses/GPL-3
+ *
+ * C++ functions for the R/broman package
+ *
+ * The sliding window used by runningmean(), runningratio(), and the
+ * block bootstrap versions: the window at position at, of width w,
+ * contains the points with at - w/2 <= pos <= at + w/2.
+ *
+ * Contains: window_bounds
+ *
+ **********************************************************************/
+
+#ifndef BROMAN_RUNNINGWINDOW_H
+#define BROMAN_RUNNINGWINDOW_H
+
+/**********************************************************************
+ * window_bounds
+ *
+ * Move [lo, hi) to the indices with left <= pos <= right
+ *
+ * We assume that pos is sorted and that left and right are
+ * non-decreasing from call to call
+ **********************************************************************/
+template<typename Pos>
+inline void window_bounds(const Pos *pos, int n, double left, double right,
+                          int &lo, int &hi)
+{
+    while(lo < n && (double)pos[lo] < left) lo++;
+    if(hi < lo) hi = lo;
+    while(hi < n && (double)pos[hi] <= right) hi++;
+}
+
+#endif // BROMAN_RUNNINGWINDOW_H
+
+/* end of runningwindow.h */
@@ -0,0 +1,500 @@
+/* simd.c
+
+   Karl W Broman
+
+   SSE2/AVX2/AVX-512 variants of the inner loops of compare_rows()
+   and count_close(), with the variant chosen at load time
+
+   The vector variants are compiled with function-level target
+   attributes, so the package doesn't need -march=native; which one
+   is used is decided at run time by CPU feature detection, with a
+   scalar fallback for other compilers and architectures.
+
+   Missing values are handled with masks:
+     - NA_real_ is a NaN with 1954 in the low word (as in R_IsNA)
+     - NA_integer_ is INT_MIN
+
+*/
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <R.h>
+#include "simd.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define BROMAN_X86_SIMD
+#include <immintrin.h>
+#if defined(__clang__) || __GNUC__ >= 7
+#define BROMAN_AVX512
+#endif
+#endif
+
+/* low word of NA_real_ */
+#define NA_LOWORD 1954
+
+/**********************************************************************
+ * scalar kernels
+ **********************************************************************/
+static void mismatch_scalar(const int *x, const int *y, int n,
+                            int *n_obs, int *n_diff)
+{
+    int k, nobs=0, ndiff=0;
+
+    for(k=0; k<n; k++) {
+        /* INT_MIN is the missing value for integers */
+        if(x[k] > INT_MIN && y[k] > INT_MIN) {
+            nobs++;
+            if(x[k] != y[k]) ndiff++;
+        }
+    }
+
+    *n_obs = nobs;
+    *n_diff = ndiff;
+}
+
+static void rmsd_scalar(const double *x, const double *y, int n,
+                        int *n_obs, double *sumsq)
+{
+    int k, nobs=0;
+    double a, s=0.0;
+
+    for(k=0; k<n; k++) {
+        if(!ISNA(x[k]) && !ISNA(y[k])) {
+            nobs++;
+            a = x[k] - y[k];
+            s += (a*a);
+        }
+    }
+
+    *n_obs = nobs;
+    *sumsq = s;
+}
+
+static int close_scalar(const double *values, int n, double v,
+                        double tol, int *counts)
+{
+    int k, total=0;
+
+    for(k=0; k<n; k++) {
+        if(fabs(v - values[k]) <= tol) {
+            counts[k]++;
+            total++;
+        }
+    }
+
+    return total;
+}
+
+#ifdef BROMAN_X86_SIMD
+/**********************************************************************
+ * SSE2 kernels
+ **********************************************************************/
+__attribute__((target("sse2")))
+static void mismatch_sse2(const int *x, const int *y, int n,
+                          int *n_obs, int *n_diff)
+{
+    int k, nobs, ndiff, tmp[4];
+    __m128i a, b, na, valid, neq;
+    __m128i vmin = _mm_set1_epi32(INT_MIN);
+    __m128i ones = _mm_set1_epi32(-1);
+    __m128i acc_obs = _mm_setzero_si128(), acc_diff = _mm_setzero_si128();
+
+    for(k=0; k+4 <= n; k+=4) {
+        a = _mm_loadu_si128((const __m128i *)(x+k));
+        b = _mm_loadu_si128((const __m128i *)(y+k));
+        na = _mm_or_si128(_mm_cmpeq_epi32(a, vmin), _mm_cmpeq_epi32(b, vmin));
+        valid = _mm_xor_si128(na, ones);
+        neq = _mm_andnot_si128(_mm_cmpeq_epi32(a, b), valid);
+        /* masks are -1/0, so subtracting adds 1 where set */
+        acc_obs = _mm_sub_epi32(acc_obs, valid);
+        acc_diff = _mm_sub_epi32(acc_diff, neq);
+    }
+
+    _mm_storeu_si128((__m128i *)tmp, acc_obs);
+    nobs = tmp[0] + tmp[1] + tmp[2] + tmp[3];
+    _mm_storeu_si128((__m128i *)tmp, acc_diff);
+    ndiff = tmp[0] + tmp[1] + tmp[2] + tmp[3];
+
+    if(k < n) {
+        int tail_obs, tail_diff;
+        mismatch_scalar(x+k, y+k, n-k, &tail_obs, &tail_diff);
+        nobs += tail_obs;
+        ndiff += tail_diff;
+    }
+
+    *n_obs = nobs;
+    *n_diff = ndiff;
+}
+
+/* mask of lanes that are NA_real_: NaN with NA_LOWORD in the low word */
+__attribute__((target("sse2")))
+static inline __m128i isna_sse2(__m128d x)
+{
+    __m128i lo = _mm_set_epi32(0, -1, 0, -1);
+    __m128i na = _mm_set_epi32(0, NA_LOWORD, 0, NA_LOWORD);
+    __m128i eq = _mm_cmpeq_epi32(_mm_and_si128(_mm_castpd_si128(x), lo), na);
+
+    /* high words always compare equal, so and the two halves of each lane */
+    eq = _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2,3,0,1)));
+    return _mm_and_si128(eq, _mm_castpd_si128(_mm_cmpunord_pd(x, x)));
+}
+
+__attribute__((target("sse2")))
+static void rmsd_sse2(const double *x, const double *y, int n,
+                      int *n_obs, double *sumsq)
+{
+    int k, nobs;
+    double s, dtmp[2];
+    long long itmp[2];
+    __m128d a, b, d;
+    __m128i na;
+    __m128i one = _mm_set_epi32(0, 1, 0, 1);
+    __m128d acc = _mm_setzero_pd();
+    __m128i acc_obs = _mm_setzero_si128();
+
+    for(k=0; k+2 <= n; k+=2) {
+        a = _mm_loadu_pd(x+k);
+        b = _mm_loadu_pd(y+k);
+        na = _mm_or_si128(isna_sse2(a), isna_sse2(b));
+        d = _mm_sub_pd(a, b);
+        acc = _mm_add_pd(acc, _mm_andnot_pd(_mm_castsi128_pd(na), _mm_mul_pd(d, d)));
+        acc_obs = _mm_add_epi64(acc_obs, _mm_andnot_si128(na, one));
+    }
+
+    _mm_storeu_pd(dtmp, acc);
+    s = dtmp[0] + dtmp[1];
+    _mm_storeu_si128((__m128i *)itmp, acc_obs);
+    nobs = (int)(itmp[0] + itmp[1]);
+
+    if(k < n) {
+        int tail_obs;
+        double tail_s;
+        rmsd_scalar(x+k, y+k, n-k, &tail_obs, &tail_s);
+        nobs += tail_obs;
+        s += tail_s;
+    }
+
+    *n_obs = nobs;
+    *sumsq = s;
+}
+
+__attribute__((target("sse2")))
+static int close_sse2(const double *values, int n, double v,
+                      double tol, int *counts)
+{
+    int k, total=0;
+    __m128d d, m;
+    __m128i c;
+    __m128d vv = _mm_set1_pd(v), tt = _mm_set1_pd(tol);
+    __m128d absmask = _mm_castsi128_pd(_mm_set_epi32(0x7fffffff, -1, 0x7fffffff, -1));
+
+    for(k=0; k+2 <= n; k+=2) {
+        d = _mm_and_pd(_mm_sub_pd(vv, _mm_loadu_pd(values+k)), absmask);
+        m = _mm_cmple_pd(d, tt); /* false for NaN */
+        total += __builtin_popcount(_mm_movemask_pd(m));
+
+        /* pack the two 64-bit masks into two 32-bit lanes and add to counts */
+        c = _mm_loadl_epi64((const __m128i *)(counts+k));
+        c = _mm_sub_epi32(c, _mm_shuffle_epi32(_mm_castpd_si128(m), _MM_SHUFFLE(3,1,2,0)));
+        _mm_storel_epi64((__m128i *)(counts+k), c);
+    }
+
+    if(k < n) total += close_scalar(values+k, n-k, v, tol, counts+k);
+
+    return total;
+}
+
+/**********************************************************************
+ * AVX2 kernels
+ **********************************************************************/
+__attribute__((target("avx2")))
+static void mismatch_avx2(const int *x, const int *y, int n,
+                          int *n_obs, int *n_diff)
+{
+    int k, nobs, ndiff, tmp[8];
+    __m256i a, b, na, valid, neq;
+    __m256i vmin = _mm256_set1_epi32(INT_MIN);
+    __m256i ones = _mm256_set1_epi32(-1);
+    __m256i acc_obs = _mm256_setzero_si256(), acc_diff = _mm256_setzero_si256();
+
+    for(k=0; k+8 <= n; k+=8) {
+        a = _mm256_loadu_si256((const __m256i *)(x+k));
+        b = _mm256_loadu_si256((const __m256i *)(y+k));
+        na = _mm256_or_si256(_mm256_cmpeq_epi32(a, vmin), _mm256_cmpeq_epi32(b, vmin));
+        valid = _mm256_xor_si256(na, ones);
+        neq = _mm256_andnot_si256(_mm256_cmpeq_epi32(a, b), valid);
+        acc_obs = _mm256_sub_epi32(acc_obs, valid);
+        acc_diff = _mm256_sub_epi32(acc_diff, neq);
+    }
+
+    _mm256_storeu_si256((__m256i *)tmp, acc_obs);
+    nobs = tmp[0] + tmp[1] + tmp[2] + tmp[3] + tmp[4] + tmp[5] + tmp[6] + tmp[7];
+    _mm256_storeu_si256((__m256i *)tmp, acc_diff);
+    ndiff = tmp[0] + tmp[1] + tmp[2] + tmp[3] + tmp[4] + tmp[5] + tmp[6] + tmp[7];
+
+    if(k < n) {
+        int tail_obs, tail_diff;
+        mismatch_scalar(x+k, y+k, n-k, &tail_obs, &tail_diff);
+        nobs += tail_obs;
+        ndiff += tail_diff;
+    }
+
+    *n_obs = nobs;
+    *n_diff = ndiff;
+}
+
+__attribute__((target("avx2")))
+static inline __m256i isna_avx2(__m256d x)
+{
+    __m256i lo = _mm256_set1_epi64x(0xffffffffLL);
+    __m256i na = _mm256_set1_epi64x(NA_LOWORD);
+    __m256i eq = _mm256_cmpeq_epi64(_mm256_and_si256(_mm256_castpd_si256(x), lo), na);
+
+    return _mm256_and_si256(eq, _mm256_castpd_si256(_mm256_cmp_pd(x, x, _CMP_UNORD_Q)));
+}
+
+__attribute__((target("avx2")))
+static void rmsd_avx2(const double *x, const double *y, int n,
+                      int *n_obs, double *sumsq)
+{
+    int k, nobs;
+    double s, dtmp[4];
+    long long itmp[4];
+    __m256d a, b, d;
+    __m256i na;
+    __m256i one = _mm256_set1_epi64x(1);
+    __m256d acc = _mm256_setzero_pd();
+    __m256i acc_obs = _mm256_setzero_si256();
+
+    for(k=0; k+4 <= n; k+=4) {
+        a = _mm256_loadu_pd(x+k);
+        b = _mm256_loadu_pd(y+k);
+        na = _mm256_or_si256(isna_avx2(a), isna_avx2(b));
+        d = _mm256_sub_pd(a, b);
+        acc = _mm256_add_pd(acc, _mm256_andnot_pd(_mm256_castsi256_pd(na), _mm256_mul_pd(d, d)));
+        acc_obs = _mm256_add_epi64(acc_obs, _mm256_andnot_si256(na, one));
+    }
+
+    _mm256_storeu_pd(dtmp, acc);
+    s = (dtmp[0] + dtmp[1]) + (dtmp[2] + dtmp[3]);
+    _mm256_storeu_si256((__m256i *)itmp, acc_obs);
+    nobs = (int)(itmp[0] + itmp[1] + itmp[2] + itmp[3]);
+
+    if(k < n) {
+        int tail_obs;
+        double tail_s;
+        rmsd_scalar(x+k, y+k, n-k, &tail_obs, &tail_s);
+        nobs += tail_obs;
+        s += tail_s;
+    }
+
+    *n_obs = nobs;
+    *sumsq = s;
+}
+
+__attribute__((target("avx2")))
+static int close_avx2(const double *values, int n, double v,
+                      double tol, int *counts)
+{
+    int k, total=0;
+    __m256d d, m;
+    __m128i c, m32;
+    __m256d vv = _mm256_set1_pd(v), tt = _mm256_set1_pd(tol);
+    __m256d absmask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7fffffffffffffffLL));
+    __m256i pack = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+
+    for(k=0; k+4 <= n; k+=4) {
+        d = _mm256_and_pd(_mm256_sub_pd(vv, _mm256_loadu_pd(values+k)), absmask);
+        m = _mm256_cmp_pd(d, tt, _CMP_LE_OQ);
+        total += __builtin_popcount(_mm256_movemask_pd(m));
+
+        /* pack the four 64-bit masks into four 32-bit lanes and add to counts */
+        m32 = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(_mm256_castpd_si256(m), pack));
+        c = _mm_loadu_si128((const __m128i *)(counts+k));
+        _mm_storeu_si128((__m128i *)(counts+k), _mm_sub_epi32(c, m32));
+    }
+
+    if(k < n) total += close_scalar(values+k, n-k, v, tol, counts+k);
+
+    return total;
+}
+
+#ifdef BROMAN_AVX512
+/**********************************************************************
+ * AVX-512 kernels (tails handled with masked loads)
+ **********************************************************************/
+__attribute__((target("avx512f")))
+static void mismatch_avx512(const int *x, const int *y, int n,
+                            int *n_obs, int *n_diff)
+{
+    int k;
+    __m512i a, b;
+    __mmask16 tail, valid, neq;
+    __m512i vmin = _mm512_set1_epi32(INT_MIN);
+    __m512i one = _mm512_set1_epi32(1);
+    __m512i acc_obs = _mm512_setzero_si512(), acc_diff = _mm512_setzero_si512();
+
+    for(k=0; k<n; k+=16) {
+        tail = (n-k >= 16) ? (__mmask16)0xffff : (__mmask16)((1u << (n-k)) - 1);
+        a = _mm512_maskz_loadu_epi32(tail, x+k);
+        b = _mm512_maskz_loadu_epi32(tail, y+k);
+        valid = tail & _mm512_cmpneq_epi32_mask(a, vmin) & _mm512_cmpneq_epi32_mask(b, vmin);
+        neq = valid & _mm512_cmpneq_epi32_mask(a, b);
+        acc_obs = _mm512_mask_add_epi32(acc_obs, valid, acc_obs, one);
+        acc_diff = _mm512_mask_add_epi32(acc_diff, neq, acc_diff, one);
+    }
+
+    *n_obs = _mm512_reduce_add_epi32(acc_obs);
+    *n_diff = _mm512_reduce_add_epi32(acc_diff);
+}
+
+__attribute__((target("avx512f")))
+static inline __mmask8 isna_avx512(__m512d x)
+{
+    __m512i lo = _mm512_set1_epi64(0xffffffffLL);
+    __m512i na = _mm512_set1_epi64(NA_LOWORD);
+
+    return _mm512_cmp_pd_mask(x, x, _CMP_UNORD_Q) &
+        _mm512_cmpeq_epi64_mask(_mm512_and_si512(_mm512_castpd_si512(x), lo), na);
+}
+
+__attribute__((target("avx512f")))
+static void rmsd_avx512(const double *x, const double *y, int n,
+                        int *n_obs, double *sumsq)
+{
+    int k, nobs=0;
+    __m512d a, b, d;
+    __mmask8 tail, valid;
+    __m512d acc = _mm512_setzero_pd();
+
+    for(k=0; k<n; k+=8) {
+        tail = (n-k >= 8) ? (__mmask8)0xff : (__mmask8)((1u << (n-k)) - 1);
+        a = _mm512_maskz_loadu_pd(tail, x+k);
+        b = _mm512_maskz_loadu_pd(tail, y+k);
+        valid = tail & ~(isna_avx512(a) | isna_avx512(b));
+        d = _mm512_maskz_sub_pd(valid, a, b);
+        acc = _mm512_add_pd(acc, _mm512_mul_pd(d, d));
+        nobs += __builtin_popcount(valid);
+    }
+
+    *n_obs = nobs;
+    *sumsq = _mm512_reduce_add_pd(acc);
+}
+
+__attribute__((target("avx512f")))
+static int close_avx512(const double *values, int n, double v,
+                        double tol, int *counts)
+{
+    int k, total=0;
+    __m512d d;
+    __m512i c;
+    __mmask8 tail, m;
+    __m512d vv = _mm512_set1_pd(v), tt = _mm512_set1_pd(tol);
+    __m512i absmask = _mm512_set1_epi64(0x7fffffffffffffffLL);
+    __m512i one = _mm512_set1_epi32(1);
+
+    for(k=0; k<n; k+=8) {
+        tail = (n-k >= 8) ? (__mmask8)0xff : (__mmask8)((1u << (n-k)) - 1);
+        d = _mm512_sub_pd(vv, _mm512_maskz_loadu_pd(tail, values+k));
+        d = _mm512_castsi512_pd(_mm512_and_si512(_mm512_castpd_si512(d), absmask));
+        m = tail & _mm512_cmp_pd_mask(d, tt, _CMP_LE_OQ);
+        total += __builtin_popcount(m);
+
+        /* lane j of the double mask lines up with int32 lane j of counts */
+        c = _mm512_maskz_loadu_epi32((__mmask16)tail, counts+k);
+        c = _mm512_mask_add_epi32(c, (__mmask16)m, c, one);
+        _mm512_mask_storeu_epi32(counts+k, (__mmask16)tail, c);
+    }
+
+    return total;
+}
+#endif // BROMAN_AVX512
+#endif // BROMAN_X86_SIMD
+
+/**********************************************************************
+ * dispatch
+ **********************************************************************/
+mismatch_kernel_t simd_mismatch = mismatch_scalar;
+rmsd_kernel_t simd_rmsd = rmsd_scalar;
+close_kernel_t simd_close = close_scalar;
+
+static int simd_current = SIMD_SCALAR;
+
+int simd_best_variant(void)
+{
+#ifdef BROMAN_X86_SIMD
+    __builtin_cpu_init();
+#ifdef BROMAN_AVX512
+    if(__builtin_cpu_supports("avx512f")) return SIMD_AVX512;
+#endif
+    if(__builtin_cpu_supports("avx2")) return SIMD_AVX2;
+    if(__builtin_cpu_supports("sse2")) return SIMD_SSE2;
+#endif
+    return SIMD_SCALAR;
+}
+
+int simd_select(int variant)
+{
+    int best = simd_best_variant();
+
+    if(variant > best) variant = best;
+    if(variant < SIMD_SCALAR) variant = SIMD_SCALAR;
+
+    switch(variant) {
+#ifdef BROMAN_X86_SIMD
+#ifdef BROMAN_AVX512
+    case SIMD_AVX512:
+        simd_mismatch = mismatch_avx512;
+        simd_rmsd = rmsd_avx512;
+        simd_close = close_avx512;
+        break;
+#endif
+    case SIMD_AVX2:
+        simd_mismatch = mismatch_avx2;
+        simd_rmsd = rmsd_avx2;
+        simd_close = close_avx2;
+        break;
+    case SIMD_SSE2:
+        simd_mismatch = mismatch_sse2;
+        simd_rmsd = rmsd_sse2;
+        simd_close = close_sse2;
+        break;
+#endif
+    default:
+        variant = SIMD_SCALAR;
+        simd_mismatch = mismatch_scalar;
+        simd_rmsd = rmsd_scalar;
+        simd_close = close_scalar;
+    }
+
+    simd_current = variant;
+    return variant;
+}
+
+void simd_init(void)
+{
+    const char *force = getenv("BROMAN_SIMD");
+    int variant = SIMD_AVX512; /* will be reduced to the best available */
+
+    if(force != NULL && force[0] != '\0') {
+        if(strcmp(force, "scalar")==0) variant = SIMD_SCALAR;
+        else if(strcmp(force, "sse2")==0) variant = SIMD_SSE2;
+        else if(strcmp(force, "avx2")==0) variant = SIMD_AVX2;
+    }
+
+    simd_select(variant);
+}
+
+/* R wrappers */
+void R_simd_variant(int *variant, int *best)
+{
+    *variant = simd_current;
+    *best = simd_best_variant();
+}
+
+void R_simd_select(int *variant)
+{
+    *variant = simd_select(*variant);
+}
@@ -0,0 +1,53 @@
+/* simd.h
+
+   Karl W Broman
+
+   SSE2/AVX2/AVX-512 variants of the inner loops of compare_rows()
+   and count_close(), with the variant chosen at load time
+
+*/
+
+#ifndef BROMAN_SIMD_H
+#define BROMAN_SIMD_H
+
+/* kernel variants, in increasing order of preference */
+#define SIMD_SCALAR 0
+#define SIMD_SSE2   1
+#define SIMD_AVX2   2
+#define SIMD_AVX512 3
+
+/* compare two integer vectors: count positions where both are
+   non-missing (n_obs) and, of those, the number that differ (n_diff) */
+typedef void (*mismatch_kernel_t)(const int *x, const int *y, int n,
+                                  int *n_obs, int *n_diff);
+
+/* compare two double vectors: count positions where both are
+   non-missing (n_obs) and sum the squared differences (sumsq) */
+typedef void (*rmsd_kernel_t)(const double *x, const double *y, int n,
+                              int *n_obs, double *sumsq);
+
+/* for each of values[0..n-1], add 1 to counts[] if |v - value| <= tol;
+   return the total number of such values */
+typedef int (*close_kernel_t)(const double *values, int n, double v,
+                              double tol, int *counts);
+
+/* currently selected kernels */
+extern mismatch_kernel_t simd_mismatch;
+extern rmsd_kernel_t simd_rmsd;
+extern close_kernel_t simd_close;
+
+/* best variant supported by this CPU */
+int simd_best_variant(void);
+
+/* select variant (falling back to the best supported variant below
+   the requested one); returns the variant actually selected */
+int simd_select(int variant);
+
+/* choose kernels at load time; BROMAN_SIMD env variable can force a variant */
+void simd_init(void);
+
+/* R wrappers */
+void R_simd_variant(int *variant, int *best);
+void R_simd_select(int *variant);
+
+#endif // BROMAN_SIMD_H